@@ -0,0 +1,602 @@
+#include "NewtonExport.h"
+#include <raylib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <math.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define MakeDir(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#define MakeDir(path) mkdir(path, 0755)
+#endif
+
+// MSVC has no pthreads, there the export runs on the calling thread.
+#ifndef _MSC_VER
+#define EXPORT_THREADS
+#include <pthread.h>
+#endif
+
+// The tree is rendered one subtree at a time, with the leaf tiles of a
+// subtree spread over the threads. Parent tiles are built by downsampling
+// their four children as soon as those are done, in Z-order, so only one
+// tile per level has to be kept around.
+#define MAX_LEVELS 40
+#define MAX_SUBTREE_DEPTH 4
+
+typedef struct ExportTile {
+    unsigned char *data;
+    int width;
+    int height;
+} ExportTile;
+
+typedef struct ExportState {
+    NewtonExportOptions options;
+    int maxLevel;       // Level with the full image size.
+    int topLevel;       // First level that fits in a single tile.
+    int subtreeLevel;   // Level of the subtree roots.
+    int subtreeCount;
+    int completed;      // Subtrees already written by an earlier run.
+    double bounds;
+
+    ExportTile levelTiles[MAX_LEVELS];
+    ExportTile *leafTiles;  // Leaves of the current subtree by position.
+    int *leafCols;          // Leaves to compute, one per job.
+    int *leafRows;
+    int leafCount;
+    int leafStride;         // Leaves along one side of a subtree.
+    int subtreeCol;
+    int subtreeRow;
+
+    long long pixels;
+    long long tiles;
+    bool failed;        // Written under failedMutex while the pool runs.
+#ifdef EXPORT_THREADS
+    pthread_mutex_t failedMutex;
+#endif
+} ExportState;
+
+//
+// A small pool of worker threads that run numbered jobs.
+//
+#ifdef EXPORT_THREADS
+typedef struct ExportPool {
+    pthread_t *threads;
+    int threadCount;
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    int generation;
+    int nextJob;
+    int jobCount;
+    int finished;
+    bool quit;
+    void (*run)(void *context, int job);
+    void *context;
+} ExportPool;
+
+static void *PoolWorker(void *arg)
+{
+    ExportPool *pool = (ExportPool *)arg;
+    int seen = 0;
+    pthread_mutex_lock(&pool->mutex);
+    while (true) {
+        while (!pool->quit && pool->generation == seen) {
+            pthread_cond_wait(&pool->start, &pool->mutex);
+        }
+        if (pool->quit) break;
+        seen = pool->generation;
+
+        while (pool->nextJob < pool->jobCount) {
+            int job = pool->nextJob++;
+            pthread_mutex_unlock(&pool->mutex);
+            pool->run(pool->context, job);
+            pthread_mutex_lock(&pool->mutex);
+            if (++pool->finished == pool->jobCount) {
+                pthread_cond_signal(&pool->done);
+            }
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+static void PoolInit(ExportPool *pool, int threadCount)
+{
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->threads = malloc(threadCount*sizeof(pthread_t));
+    for (int i = 0; i < threadCount; i++) {
+        if (pthread_create(&pool->threads[i], NULL, PoolWorker, pool) != 0) break;
+        pool->threadCount++;
+    }
+}
+
+static void PoolRun(ExportPool *pool, int jobCount, void (*run)(void *, int), void *context)
+{
+    if (jobCount <= 0) return;
+    if (pool->threadCount == 0) {
+        for (int i = 0; i < jobCount; i++) run(context, i);
+        return;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    pool->run = run;
+    pool->context = context;
+    pool->jobCount = jobCount;
+    pool->nextJob = 0;
+    pool->finished = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    while (pool->finished < pool->jobCount) {
+        pthread_cond_wait(&pool->done, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static void PoolFree(ExportPool *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < pool->threadCount; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    free(pool->threads);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+}
+#else
+typedef struct ExportPool {
+    int threadCount;
+} ExportPool;
+
+static void PoolInit(ExportPool *pool, int threadCount)
+{
+    pool->threadCount = 0;
+}
+
+static void PoolRun(ExportPool *pool, int jobCount, void (*run)(void *, int), void *context)
+{
+    for (int i = 0; i < jobCount; i++) run(context, i);
+}
+
+static void PoolFree(ExportPool *pool)
+{
+}
+#endif
+
+//
+// The fractal itself, the same iteration as pixel.fs.
+//
+static void ComputeNewtonPixel(double x, double y, int maxIterations, unsigned char *rgb)
+{
+    static const double roots[3][2] = {
+        { 1, 0 },
+        { -0.5, 0.86602540378443864676 },
+        { -0.5, -0.86602540378443864676 }
+    };
+    double tolerance = 0.001;
+    int root = -1;
+    int i = 0;
+    for ( ; i < maxIterations; i++) {
+        // z = z - (z^3 - 1)/(3z^2)
+        double x2 = x*x - y*y;
+        double y2 = 2*x*y;
+        double fx = x2*x - y2*y - 1;
+        double fy = x2*y + y2*x;
+        double dx = 3*x2;
+        double dy = 3*y2;
+        double d = dx*dx + dy*dy;
+        x -= (fx*dx + fy*dy)/d;
+        y -= (fy*dx - fx*dy)/d;
+
+        for (int j = 0; j < 3; j++) {
+            if (fabs(x - roots[j][0]) < tolerance && fabs(y - roots[j][1]) < tolerance) {
+                root = j;
+            }
+        }
+        if (root >= 0) {
+            break;
+        }
+    }
+    unsigned char shade = root >= 0 ? (unsigned char)(255*(1.0 - (double)i/maxIterations)): 0;
+    rgb[0] = root == 0 ? shade: 0;
+    rgb[1] = root == 1 ? shade: 0;
+    rgb[2] = root == 2 ? shade: 0;
+}
+
+//
+// Tiles and levels.
+//
+static int GetLevelSize(int size, int level, int maxLevel)
+{
+    for (int i = level; i < maxLevel; i++) {
+        size = (size + 1)/2;
+    }
+    return size;
+}
+
+static void GetTileSize(ExportState *state, int level, int col, int row, int *width, int *height)
+{
+    int tileSize = state->options.tileSize;
+    int levelWidth = GetLevelSize(state->options.width, level, state->maxLevel);
+    int levelHeight = GetLevelSize(state->options.height, level, state->maxLevel);
+    *width = levelWidth - col*tileSize < tileSize ? levelWidth - col*tileSize: tileSize;
+    *height = levelHeight - row*tileSize < tileSize ? levelHeight - row*tileSize: tileSize;
+}
+
+static bool TileExists(ExportState *state, int level, int col, int row)
+{
+    int width, height;
+    GetTileSize(state, level, col, row, &width, &height);
+    return width > 0 && height > 0;
+}
+
+static const char *GetTilePath(ExportState *state, int level, int col, int row)
+{
+    return TextFormat("%s_files/%d/%d_%d.png", state->options.name, level, col, row);
+}
+
+static void WriteTile(ExportState *state, int level, int col, int row, ExportTile *tile)
+{
+    Image image = { tile->data, tile->width, tile->height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8 };
+    // ExportImage and TextFormat use static buffers for file names, so the
+    // tile is encoded in memory and written to a path built on the stack.
+    char path[1024];
+    snprintf(path, sizeof(path), "%s_files/%d/%d_%d.png", state->options.name, level, col, row);
+    int size = 0;
+    unsigned char *png = ExportImageToMemory(image, ".png", &size);
+    FILE *file = png ? fopen(path, "wb"): NULL;
+    bool ok = file && fwrite(png, 1, size, file) == (size_t)size;
+    if (file) ok = (fclose(file) == 0) && ok;
+    MemFree(png);
+    if (ok) return;
+
+#ifdef EXPORT_THREADS
+    pthread_mutex_lock(&state->failedMutex);
+#endif
+    state->failed = true;
+#ifdef EXPORT_THREADS
+    pthread_mutex_unlock(&state->failedMutex);
+#endif
+}
+
+static ExportTile *GetSubtreeLeaf(ExportState *state, int col, int row)
+{
+    int localCol = col - state->subtreeCol*state->leafStride;
+    int localRow = row - state->subtreeRow*state->leafStride;
+    return &state->leafTiles[localRow*state->leafStride + localCol];
+}
+
+static void ComputeLeaf(void *context, int job)
+{
+    ExportState *state = (ExportState *)context;
+    int col = state->leafCols[job];
+    int row = state->leafRows[job];
+    ExportTile *tile = GetSubtreeLeaf(state, col, row);
+    int tileSize = state->options.tileSize;
+    GetTileSize(state, state->maxLevel, col, row, &tile->width, &tile->height);
+
+    // The shorter side of the image spans [-bounds, bounds].
+    int shortSide = state->options.width < state->options.height ? state->options.width: state->options.height;
+    double pixelSize = 2*state->bounds/shortSide;
+    double left = -pixelSize*state->options.width/2;
+    double top = -pixelSize*state->options.height/2;
+    for (int y = 0; y < tile->height; y++) {
+        double zy = top + pixelSize*(row*tileSize + y + 0.5);
+        for (int x = 0; x < tile->width; x++) {
+            double zx = left + pixelSize*(col*tileSize + x + 0.5);
+            ComputeNewtonPixel(zx, zy, state->options.maxIterations, &tile->data[3*(y*tile->width + x)]);
+        }
+    }
+    WriteTile(state, state->maxLevel, col, row, tile);
+}
+
+// Average 2x2 blocks of the child into its quadrant of the parent.
+static void DownsampleInto(ExportTile *parent, ExportTile *child, int quadX, int quadY, int tileSize)
+{
+    int offsetX = quadX*tileSize/2;
+    int offsetY = quadY*tileSize/2;
+    int width = (child->width + 1)/2;
+    int height = (child->height + 1)/2;
+    for (int y = 0; y < height && offsetY + y < parent->height; y++) {
+        int y0 = 2*y;
+        int y1 = 2*y + 1 < child->height ? 2*y + 1: 2*y;
+        for (int x = 0; x < width && offsetX + x < parent->width; x++) {
+            int x0 = 2*x;
+            int x1 = 2*x + 1 < child->width ? 2*x + 1: 2*x;
+            unsigned char *out = &parent->data[3*((offsetY + y)*parent->width + offsetX + x)];
+            for (int c = 0; c < 3; c++) {
+                int sum = child->data[3*(y0*child->width + x0) + c] + child->data[3*(y0*child->width + x1) + c] +
+                    child->data[3*(y1*child->width + x0) + c] + child->data[3*(y1*child->width + x1) + c];
+                out[c] = (sum + 2)/4;
+            }
+        }
+    }
+}
+
+// Build a tile inside the current subtree from its already computed leaves.
+static void AssembleTile(ExportState *state, int level, int col, int row, ExportTile *out)
+{
+    GetTileSize(state, level, col, row, &out->width, &out->height);
+    memset(out->data, 0, 3*out->width*out->height);
+    for (int i = 0; i < 4; i++) {
+        int childCol = 2*col + i%2;
+        int childRow = 2*row + i/2;
+        if (!TileExists(state, level+1, childCol, childRow)) continue;
+
+        ExportTile *child;
+        if (level+1 == state->maxLevel) {
+            child = GetSubtreeLeaf(state, childCol, childRow);
+        } else {
+            child = &state->levelTiles[level+1];
+            AssembleTile(state, level+1, childCol, childRow, child);
+        }
+        DownsampleInto(out, child, i%2, i/2, state->options.tileSize);
+    }
+    WriteTile(state, level, col, row, out);
+    state->tiles++;
+}
+
+static bool LoadTile(ExportState *state, int level, int col, int row, ExportTile *out)
+{
+    GetTileSize(state, level, col, row, &out->width, &out->height);
+    Image image = LoadImage(GetTilePath(state, level, col, row));
+    bool ok = image.data && image.width == out->width && image.height == out->height &&
+        image.format == PIXELFORMAT_UNCOMPRESSED_R8G8B8;
+    if (ok) {
+        memcpy(out->data, image.data, 3*out->width*out->height);
+    }
+    UnloadImage(image);
+    return ok;
+}
+
+static void SaveProgress(ExportState *state, int completed)
+{
+    char path[1024];
+    char tmpPath[1040];
+    snprintf(path, sizeof(path), "%s_files/progress.txt", state->options.name);
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+    FILE *file = fopen(tmpPath, "w");
+    if (!file) return;
+    NewtonExportOptions *o = &state->options;
+    fprintf(file, "%d %d %d %d %d %d\n", o->width, o->height, o->tileSize, o->maxIterations, state->subtreeLevel, completed);
+    fclose(file);
+#ifdef _WIN32
+    remove(path);
+#endif
+    rename(tmpPath, path);
+}
+
+static int LoadProgress(ExportState *state)
+{
+    FILE *file = fopen(TextFormat("%s_files/progress.txt", state->options.name), "r");
+    if (!file) return 0;
+    int width, height, tileSize, maxIterations, subtreeLevel, completed;
+    NewtonExportOptions *o = &state->options;
+    bool ok = fscanf(file, "%d %d %d %d %d %d", &width, &height, &tileSize, &maxIterations, &subtreeLevel, &completed) == 6 &&
+        width == o->width && height == o->height && tileSize == o->tileSize &&
+        maxIterations == o->maxIterations && subtreeLevel == state->subtreeLevel;
+    fclose(file);
+    return ok ? completed: 0;
+}
+
+static double GetSeconds(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static long GetPeakMemoryKB(void)
+{
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss/1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+static void RenderSubtree(ExportState *state, ExportPool *pool, int col, int row, ExportTile *out)
+{
+    // Collect the leaves under this subtree root and compute them in parallel.
+    state->subtreeCol = col;
+    state->subtreeRow = row;
+    int count = 0;
+    for (int y = 0; y < state->leafStride; y++) {
+        for (int x = 0; x < state->leafStride; x++) {
+            int leafCol = col*state->leafStride + x;
+            int leafRow = row*state->leafStride + y;
+            if (!TileExists(state, state->maxLevel, leafCol, leafRow)) continue;
+            state->leafCols[count] = leafCol;
+            state->leafRows[count] = leafRow;
+            count++;
+        }
+    }
+    PoolRun(pool, count, ComputeLeaf, state);
+    for (int i = 0; i < count; i++) {
+        ExportTile *leaf = GetSubtreeLeaf(state, state->leafCols[i], state->leafRows[i]);
+        state->pixels += (long long)leaf->width*leaf->height;
+    }
+    state->tiles += count;
+
+    if (state->subtreeLevel == state->maxLevel) {
+        ExportTile *leaf = GetSubtreeLeaf(state, col, row);
+        out->width = leaf->width;
+        out->height = leaf->height;
+        memcpy(out->data, leaf->data, 3*leaf->width*leaf->height);
+    } else {
+        AssembleTile(state, state->subtreeLevel, col, row, out);
+    }
+}
+
+static void RenderTile(ExportState *state, ExportPool *pool, int level, int col, int row, ExportTile *out, int *subtreeIndex, double startTime)
+{
+    // A failed write stops the export, so no later subtree is recorded
+    // as done while a tile before it is missing.
+    if (state->failed) return;
+    if (level == state->subtreeLevel) {
+        int index = (*subtreeIndex)++;
+        if (index < state->completed && LoadTile(state, level, col, row, out)) {
+            return;
+        }
+        RenderSubtree(state, pool, col, row, out);
+        if (state->failed) return;
+        SaveProgress(state, index + 1);
+
+        double elapsed = GetSeconds() - startTime;
+        printf("Subtree %d/%d, %lld tiles, %.1f Mpixel/s, %.1f MB/s raw, peak RSS %ld MB\n",
+            index + 1, state->subtreeCount, state->tiles, state->pixels/elapsed/1e6,
+            3*state->pixels/elapsed/1e6, GetPeakMemoryKB()/1024);
+        fflush(stdout);
+        return;
+    }
+
+    GetTileSize(state, level, col, row, &out->width, &out->height);
+    memset(out->data, 0, 3*out->width*out->height);
+    for (int i = 0; i < 4; i++) {
+        int childCol = 2*col + i%2;
+        int childRow = 2*row + i/2;
+        if (!TileExists(state, level+1, childCol, childRow)) continue;
+        ExportTile *child = &state->levelTiles[level+1];
+        RenderTile(state, pool, level+1, childCol, childRow, child, subtreeIndex, startTime);
+        if (state->failed) return;
+        DownsampleInto(out, child, i%2, i/2, state->options.tileSize);
+    }
+    WriteTile(state, level, col, row, out);
+    state->tiles++;
+}
+
+int ExportNewtonFractal(NewtonExportOptions options)
+{
+    if (options.tileSize <= 0) options.tileSize = 256;
+    if (options.maxIterations <= 0) options.maxIterations = 30;
+#ifndef EXPORT_THREADS
+    options.threads = 1;
+#endif
+    if (options.threads <= 0) {
+#ifdef _WIN32
+        options.threads = 4;
+#else
+        options.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (options.threads <= 0) options.threads = 1;
+#endif
+    }
+    if (options.width <= 0 || options.height <= 0 || options.tileSize % 2 != 0 || !options.name) {
+        printf("Invalid export options\n");
+        return 1;
+    }
+
+    // Loading tiles on resume would otherwise log a line each.
+    SetTraceLogLevel(LOG_WARNING);
+
+    ExportState state = { 0 };
+    state.options = options;
+    state.bounds = 2;
+    int largest = options.width > options.height ? options.width: options.height;
+    while ((1 << state.maxLevel) < largest) state.maxLevel++;
+    state.topLevel = state.maxLevel;
+    while (GetLevelSize(largest, state.topLevel, state.maxLevel) > options.tileSize) {
+        state.topLevel--;
+    }
+
+    // Pick subtrees with enough leaves to keep every thread busy.
+    int depth = 0;
+    while (depth < MAX_SUBTREE_DEPTH && (1 << (2*depth)) < 4*options.threads) depth++;
+    state.subtreeLevel = state.maxLevel - depth > state.topLevel ? state.maxLevel - depth: state.topLevel;
+    depth = state.maxLevel - state.subtreeLevel;
+    int rootTilesX = (GetLevelSize(options.width, state.subtreeLevel, state.maxLevel) + options.tileSize - 1)/options.tileSize;
+    int rootTilesY = (GetLevelSize(options.height, state.subtreeLevel, state.maxLevel) + options.tileSize - 1)/options.tileSize;
+    state.subtreeCount = rootTilesX*rootTilesY;
+
+    // One tile per level plus the leaves of one subtree.
+    size_t tileBytes = 3*(size_t)options.tileSize*options.tileSize;
+    state.leafStride = 1 << depth;
+    state.leafCount = state.leafStride*state.leafStride;
+    state.leafTiles = calloc(state.leafCount, sizeof(ExportTile));
+    state.leafCols = calloc(state.leafCount, sizeof(int));
+    state.leafRows = calloc(state.leafCount, sizeof(int));
+    for (int i = 0; i < state.leafCount; i++) {
+        state.leafTiles[i].data = malloc(tileBytes);
+    }
+    for (int level = 0; level <= state.maxLevel; level++) {
+        state.levelTiles[level].data = malloc(tileBytes);
+    }
+
+    MakeDir(TextFormat("%s_files", options.name));
+    for (int level = 0; level <= state.maxLevel; level++) {
+        MakeDir(TextFormat("%s_files/%d", options.name, level));
+    }
+    state.completed = LoadProgress(&state);
+    if (state.completed > 0) {
+        printf("Resuming after %d of %d subtrees\n", state.completed, state.subtreeCount);
+    }
+    printf("Exporting %dx%d, %d levels, %d threads\n", options.width, options.height, state.maxLevel + 1, options.threads);
+
+#ifdef EXPORT_THREADS
+    pthread_mutex_init(&state.failedMutex, NULL);
+#endif
+    ExportPool pool;
+    PoolInit(&pool, options.threads);
+    double startTime = GetSeconds();
+    int subtreeIndex = 0;
+    ExportTile *top = &state.levelTiles[state.topLevel];
+    RenderTile(&state, &pool, state.topLevel, 0, 0, top, &subtreeIndex, startTime);
+    PoolFree(&pool);
+
+    // The levels below the top are single tiles, halved each time.
+    for (int level = state.topLevel - 1; level >= 0 && !state.failed; level--) {
+        ExportTile *tile = &state.levelTiles[level];
+        GetTileSize(&state, level, 0, 0, &tile->width, &tile->height);
+        DownsampleInto(tile, &state.levelTiles[level+1], 0, 0, options.tileSize);
+        WriteTile(&state, level, 0, 0, tile);
+        state.tiles++;
+    }
+
+    if (!state.failed) {
+        FILE *file = fopen(TextFormat("%s.dzi", options.name), "w");
+        if (file) {
+            fprintf(file, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"png\" Overlap=\"0\" TileSize=\"%d\">\n"
+                "  <Size Width=\"%d\" Height=\"%d\"/>\n"
+                "</Image>\n", options.tileSize, options.width, options.height);
+            fclose(file);
+        }
+        state.failed = !file;
+        remove(TextFormat("%s_files/progress.txt", options.name));
+    }
+
+    double elapsed = GetSeconds() - startTime;
+    printf("%s: %lld tiles in %.1f s, %.1f Mpixel/s, peak RSS %ld MB\n", state.failed ? "Failed": "Done",
+        state.tiles, elapsed, state.pixels/elapsed/1e6, GetPeakMemoryKB()/1024);
+
+    for (int i = 0; i < state.leafCount; i++) {
+        free(state.leafTiles[i].data);
+    }
+    for (int level = 0; level <= state.maxLevel; level++) {
+        free(state.levelTiles[level].data);
+    }
+    free(state.leafTiles);
+    free(state.leafCols);
+    free(state.leafRows);
+#ifdef EXPORT_THREADS
+    pthread_mutex_destroy(&state.failedMutex);
+#endif
+    return state.failed ? 1: 0;
+}
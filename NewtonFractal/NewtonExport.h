@@ -0,0 +1,21 @@
+#ifndef NEWTON_EXPORT_H
+#define NEWTON_EXPORT_H
+
+// Headless export of the Newton fractal to a Deep Zoom (DZI) pyramid.
+// The image is rendered on the CPU tile by tile, so its size is only
+// limited by disk space. Memory use depends on the tile size and thread
+// count, not on the image size.
+typedef struct NewtonExportOptions {
+    const char *name;       // Writes <name>.dzi and the tiles in <name>_files/.
+    int width;
+    int height;
+    int tileSize;           // Must be even, 256 when 0.
+    int maxIterations;      // 30 when 0, the default of the interactive view.
+    int threads;            // Number of cores when 0.
+} NewtonExportOptions;
+
+// Returns 0 on success. An interrupted export continues where it left off
+// when it is started again with the same options.
+int ExportNewtonFractal(NewtonExportOptions options);
+
+#endif
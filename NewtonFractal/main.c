@@ -1,10 +1,30 @@
 #include <raylib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NewtonExport.h"
 
 #define RAYGUI_IMPLEMENTATION
 #include "raygui.h"
 
-int main()
+int main(int argc, char **argv)
 {
+    // Headless export: --export <width> <height> <name> [iterations] [threads] [tilesize]
+    if (argc > 1 && strcmp(argv[1], "--export") == 0) {
+        if (argc < 5) {
+            printf("Usage: %s --export <width> <height> <name> [iterations] [threads] [tilesize]\n", argv[0]);
+            return 1;
+        }
+        NewtonExportOptions options = { 0 };
+        options.width = atoi(argv[2]);
+        options.height = atoi(argv[3]);
+        options.name = argv[4];
+        if (argc > 5) options.maxIterations = atoi(argv[5]);
+        if (argc > 6) options.threads = atoi(argv[6]);
+        if (argc > 7) options.tileSize = atoi(argv[7]);
+        return ExportNewtonFractal(options);
+    }
+
     InitWindow(800, 800, "ComPlex");
     SetTargetFPS(144);
 
@@ -0,0 +1,272 @@
+#include "Classify.h"
+#include "Polygon.h"
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Points handed to one thread at a time. A multiple of 8 so every
+// chunk starts on a whole byte of the mask.
+#define CHUNK_POINTS (1 << 20)
+#define OUTSIDE_ID 0xFFFF
+
+// Read-only access to a file of float2 points. The file is mapped, the
+// kernel is told which part comes next and which part can be dropped,
+// so only a few batches are resident at once. Windows has no mapping
+// here and reads each batch into a buffer instead.
+class PointFile {
+    size_t count = 0;
+#ifndef _WIN32
+    void *map = nullptr;
+    size_t mapSize = 0;
+#else
+    FILE *file = nullptr;
+    vector<Vector2> buffer;
+#endif
+
+    void Advise(size_t first, size_t n, int advice)
+    {
+#ifndef _WIN32
+        if (!map || n == 0) return;
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t begin = first*sizeof(Vector2)/page*page;
+        size_t end = min(mapSize, (first + n)*sizeof(Vector2));
+        madvise((char *)map + begin, end - begin, advice);
+#endif
+    }
+
+public:
+    ~PointFile()
+    {
+#ifndef _WIN32
+        if (map) munmap(map, mapSize);
+#else
+        if (file) fclose(file);
+#endif
+    }
+    bool Open(const char *path)
+    {
+#ifndef _WIN32
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0;
+        mapSize = ok ? st.st_size: 0;
+        if (ok && mapSize > 0) {
+            map = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) map = nullptr;
+            ok = map != nullptr;
+            if (ok) madvise(map, mapSize, MADV_SEQUENTIAL);
+        }
+        close(fd);
+        count = ok ? mapSize/sizeof(Vector2): 0;
+        return ok;
+#else
+        file = fopen(path, "rb");
+        if (!file) return false;
+        _fseeki64(file, 0, SEEK_END);
+        count = _ftelli64(file)/sizeof(Vector2);
+        _fseeki64(file, 0, SEEK_SET);
+        return true;
+#endif
+    }
+    size_t GetCount()
+    {
+        return count;
+    }
+    // Batches have to be requested in order.
+    const Vector2 *Get(size_t first, size_t n)
+    {
+#ifndef _WIN32
+        return (const Vector2 *)map + first;
+#else
+        buffer.resize(n);
+        size_t read = fread(buffer.data(), sizeof(Vector2), n, file);
+        if (read < n) memset(&buffer[read], 0, (n - read)*sizeof(Vector2));
+        return buffer.data();
+#endif
+    }
+    void Prefetch(size_t first, size_t n)
+    {
+#ifndef _WIN32
+        Advise(first, n, MADV_WILLNEED);
+#endif
+    }
+    void Release(size_t first, size_t n)
+    {
+#ifndef _WIN32
+        Advise(first, n, MADV_DONTNEED);
+#endif
+    }
+};
+
+// Only convex polygons are supported, IsPointInsideConvex would give
+// wrong answers for any other shape.
+static bool LoadPolygons(const char *path, vector<Polygon> &polygons)
+{
+    if (strcmp(path, "-") == 0) {
+        polygons.emplace_back();
+        polygons.back().LoadShape(0);
+        return true;
+    }
+    ifstream file(path);
+    if (!file) return false;
+    string line;
+    for (int lineNr = 1; getline(file, line); lineNr++) {
+        istringstream stream(line);
+        vector<Vector2> points;
+        Vector2 point;
+        while (stream >> point.x >> point.y) {
+            points.push_back(point);
+        }
+        if (points.size() < 3) continue;
+        polygons.emplace_back();
+        polygons.back().SetPoints(points);
+        if (!polygons.back().IsConvex()) {
+            printf("Polygon on line %d of %s is not convex\n", lineNr, path);
+            return false;
+        }
+    }
+    return !polygons.empty();
+}
+
+// Classify one chunk, returns the number of points inside a polygon.
+static size_t ClassifyChunk(const vector<Polygon> &polygons, const Vector2 *points, size_t count, uint8_t *output, bool ids)
+{
+    size_t inside = 0;
+    for (size_t i = 0; i < count; i += 8) {
+        uint8_t mask = 0;
+        for (size_t j = i; j < i+8 && j < count; j++) {
+            uint16_t id = OUTSIDE_ID;
+            for (size_t k = 0; k < polygons.size(); k++) {
+                if (polygons[k].IsPointInsideConvex(points[j])) {
+                    id = k;
+                    break;
+                }
+            }
+            inside += id != OUTSIDE_ID;
+            if (ids) {
+                memcpy(output + 2*j, &id, sizeof(id));
+            } else {
+                mask |= (id != OUTSIDE_ID) << (j - i);
+            }
+        }
+        if (!ids) output[i/8] = mask;
+    }
+    return inside;
+}
+
+static long GetPeakMemoryKB()
+{
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss/1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+int RunClassifyPipeline(int argc, char **argv)
+{
+    if (argc < 5 || (argc > 5 && strcmp(argv[5], "mask") != 0 && strcmp(argv[5], "ids") != 0)) {
+        printf("Usage: %s --classify <points.bin> <polygons.txt|-> <out.bin> [mask|ids] [threads]\n", argv[0]);
+        return 1;
+    }
+    bool ids = argc > 5 && strcmp(argv[5], "ids") == 0;
+    int threads = argc > 6 ? atoi(argv[6]): thread::hardware_concurrency();
+    if (threads <= 0) threads = 1;
+
+    vector<Polygon> polygons;
+    if (!LoadPolygons(argv[3], polygons)) {
+        printf("Failed to load polygons from %s\n", argv[3]);
+        return 1;
+    }
+    if (ids && polygons.size() >= OUTSIDE_ID) {
+        printf("Too many polygons for 16 bit ids\n");
+        return 1;
+    }
+    PointFile points;
+    if (!points.Open(argv[2])) {
+        printf("Failed to open %s\n", argv[2]);
+        return 1;
+    }
+    FILE *out = fopen(argv[4], "wb");
+    if (!out) {
+        printf("Failed to open %s for writing\n", argv[4]);
+        return 1;
+    }
+
+    // Every thread gets one chunk per batch. While a batch is classified
+    // into one output buffer, the previous one is written from the other.
+    size_t total = points.GetCount();
+    size_t batchPoints = (size_t)threads*CHUNK_POINTS;
+    vector<uint8_t> outputs[2];
+    outputs[0].resize(ids ? 2*batchPoints: batchPoints/8);
+    outputs[1].resize(outputs[0].size());
+    vector<size_t> insideCounts(threads);
+    size_t inside = 0;
+    bool writeOk = true;
+    thread writer;
+
+    auto startTime = chrono::steady_clock::now();
+    points.Prefetch(0, min(batchPoints, total));
+    for (size_t first = 0, batch = 0; first < total; first += batchPoints, batch++) {
+        size_t count = min(batchPoints, total - first);
+        const Vector2 *batchData = points.Get(first, count);
+        points.Prefetch(first + count, min(batchPoints, total - first - count));
+        uint8_t *output = outputs[batch%2].data();
+
+        vector<thread> workers;
+        for (int t = 0; t < threads && (size_t)t*CHUNK_POINTS < count; t++) {
+            size_t start = (size_t)t*CHUNK_POINTS;
+            size_t n = min((size_t)CHUNK_POINTS, count - start);
+            uint8_t *chunkOutput = output + (ids ? 2*start: start/8);
+            workers.emplace_back([&, t, start, n, chunkOutput]() {
+                insideCounts[t] = ClassifyChunk(polygons, batchData + start, n, chunkOutput, ids);
+            });
+        }
+        for (thread &worker: workers) {
+            worker.join();
+        }
+        for (int t = 0; t < workers.size(); t++) {
+            inside += insideCounts[t];
+        }
+        points.Release(first, count);
+
+        if (writer.joinable()) writer.join();
+        size_t bytes = ids ? 2*count: (count + 7)/8;
+        writer = thread([out, output, bytes, &writeOk]() {
+            if (fwrite(output, 1, bytes, out) != bytes) writeOk = false;
+        });
+    }
+    if (writer.joinable()) writer.join();
+    writeOk = (fclose(out) == 0) && writeOk;
+
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    printf("%zu points, %zu inside, %.3f s, %.2f GB/s, %.1f Mpoints/s, peak RSS %ld MB\n",
+        total, inside, elapsed, total*sizeof(Vector2)/elapsed/1e9, total/elapsed/1e6, GetPeakMemoryKB()/1024);
+    if (!writeOk) {
+        printf("Failed to write %s\n", argv[4]);
+        return 1;
+    }
+    return 0;
+}
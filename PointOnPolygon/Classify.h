@@ -0,0 +1,15 @@
+#ifndef CLASSIFY_H
+#define CLASSIFY_H
+
+// Command line stage that classifies a binary file of float2 points against
+// a set of convex polygons, without opening a window:
+//
+//   PointOnPolygon --classify <points.bin> <polygons.txt|-> <out.bin> [mask|ids] [threads]
+//
+// The polygon file has one polygon per line as "x0 y0 x1 y1 ...",
+// "-" uses the built in shape. The output is either one bit per point
+// (least significant bit first) telling if it is inside any polygon,
+// or one uint16 per point with the first polygon it is in, 0xFFFF if none.
+int RunClassifyPipeline(int argc, char **argv);
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef POLYGON_H
+#define POLYGON_H
+
+#include <raylib.h>
+#include <vector>
+#include <raymath.h>
+using namespace std;
+
+class Polygon {
+    vector<Vector2> points;
+    Vector2 center;
+    Vector2 boundsMin;
+    Vector2 boundsMax;
+public:
+    Vector2 origin;
+    float size;
+
+    Polygon() {};
+    void SetPoints(vector<Vector2> _points)
+    {
+        points = _points;
+        ComputeCenter();
+    }
+    void LoadShape(int shapeNr) {
+        shapeNr = shapeNr % 1;
+        switch(shapeNr) {
+            case 0: 
+            {
+                vector<Vector2> _points = {
+                    { 1, 0 },
+                    { 0, 1 },
+                    { -1, 0 },
+                    { 0, -1 }
+                };
+                points = _points;
+            }
+        }
+        ComputeCenter();
+    }
+    void Draw(bool filled)
+    { 
+        for (int i = 0; i < points.size(); i++) {
+            Vector2 u = points[i];
+            Vector2 v = points[(i+1)%points.size()];
+            DrawLineV(Transform(u), Transform(v), BLUE);
+        }
+        vector<Vector2> fan = { Transform(center) };
+        for (Vector2 u: points) {
+            Vector2 tu = Transform(u);
+            DrawCircleV(tu, 5, GREEN);
+            fan.push_back(tu);
+        }
+        fan.push_back(fan[1]);
+
+        if (filled) {
+            DrawTriangleFan(fan.data(), fan.size(), Fade(BLUE, 0.2));
+        }
+    }
+    float GetWindingDegrees(Vector2 point)
+    {
+        float winding = 0;
+        for (int i = 0; i < points.size(); i++) {
+            Vector2 u = points[i];
+            Vector2 v = points[(i+1)%points.size()];
+            Vector2 pu = Vector2Normalize(Vector2Subtract(u, point));
+            Vector2 pv = Vector2Normalize(Vector2Subtract(v, point));
+            
+            // cos(a) = <pu, pv> / |pu||pv|
+            float angle = acosf(Vector2DotProduct(pu, pv));
+            winding += angle;
+        }
+        return RAD2DEG*winding;
+    }
+
+    void DrawAngleLines(Vector2 point)
+    {
+        Vector2 p = Transform(point);
+        vector<float> angles;
+        angles.resize(points.size());
+        float winding = 0;
+
+        for (int i = 0; i < points.size(); i++) {
+            Vector2 u = points[i];
+            Vector2 v = points[(i+1)%points.size()];
+            Vector2 pu = Vector2Normalize(Vector2Subtract(u, point));
+            Vector2 pv = Vector2Normalize(Vector2Subtract(v, point));
+            
+            // cos(a) = <pu, pv> / |pu||pv|
+            float angle = acosf(Vector2DotProduct(pu, pv));
+            angles[i] = angle;
+            winding += angle;
+            DrawLineV(p, Transform(u), Fade(RED, 0.8));
+        }
+        for (int i = 0; i < points.size(); i++) {
+            Vector2 u = Transform(points[i]);
+            Vector2 v = Transform(points[(i+1)%points.size()]);
+            Vector2 avg = Vector2Scale(Vector2Add(p, Vector2Add(u, v)), 0.333f);
+
+            float ang = RAD2DEG*angles[i];
+            DrawText(TextFormat("%.0f", ang), avg.x, avg.y-20, 20, MAGENTA);
+        }
+        DrawText(TextFormat("%.0f", RAD2DEG*winding), p.x-15, p.y-20, 20, MAGENTA);
+    }
+    void ComputeCenter() 
+    {
+        center = {};
+        for (Vector2 u: points) { center = Vector2Add(center, u); }
+        Vector2Scale(center, 1.0/points.size());
+
+        boundsMin = boundsMax = points.empty() ? Vector2{}: points[0];
+        for (Vector2 u: points) {
+            boundsMin = { fminf(boundsMin.x, u.x), fminf(boundsMin.y, u.y) };
+            boundsMax = { fmaxf(boundsMax.x, u.x), fmaxf(boundsMax.y, u.y) };
+        }
+    }
+    bool IsPointInside(Vector2 point)
+    {
+        return GetWindingDegrees(point) >= 359.9;
+    }
+    // Inside test for convex polygons, without the acos calls. The point
+    // has to be on the same side of every edge, points on an edge count as
+    // inside. NaN would compare false everywhere, so it is rejected first.
+    bool IsPointInsideConvex(Vector2 point) const
+    {
+        if (!isfinite(point.x) || !isfinite(point.y)) {
+            return false;
+        }
+        if (point.x < boundsMin.x || point.x > boundsMax.x || point.y < boundsMin.y || point.y > boundsMax.y) {
+            return false;
+        }
+        bool hasLeft = false;
+        bool hasRight = false;
+        Vector2 u = points.back();
+        for (Vector2 v: points) {
+            float cross = (v.x - u.x)*(point.y - u.y) - (v.y - u.y)*(point.x - u.x);
+            hasLeft |= cross > 0;
+            hasRight |= cross < 0;
+            if (hasLeft && hasRight) return false;
+            u = v;
+        }
+        return true;
+    }
+    // Every corner has to turn the same way and the corners together
+    // one full turn, which also rules out self intersecting stars.
+    bool IsConvex() const
+    {
+        if (points.size() < 3) return false;
+        bool hasLeft = false;
+        bool hasRight = false;
+        float turning = 0;
+        for (int i = 0; i < points.size(); i++) {
+            Vector2 u = points[i];
+            Vector2 v = points[(i+1)%points.size()];
+            Vector2 w = points[(i+2)%points.size()];
+            if (!isfinite(u.x) || !isfinite(u.y)) return false;
+            Vector2 uv = Vector2Subtract(v, u);
+            Vector2 vw = Vector2Subtract(w, v);
+            float cross = uv.x*vw.y - uv.y*vw.x;
+            hasLeft |= cross > 0;
+            hasRight |= cross < 0;
+            turning += atan2f(cross, Vector2DotProduct(uv, vw));
+        }
+        return !(hasLeft && hasRight) && fabsf(fabsf(turning) - 2*PI) < 0.01f;
+    }
+
+    Vector2 Transform(Vector2 point)
+    {
+        return Vector2Add(origin, Vector2Multiply(point, { size, -size }));
+    }
+    Vector2 InvTransform(Vector2 point)
+    {
+        return Vector2Multiply(Vector2Subtract(point, origin), { 1.0f/size, -1.0f/size } );
+    }
+};
+
+#endif
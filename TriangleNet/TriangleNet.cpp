@@ -1,70 +1,284 @@
 #include "TriangleNet.h"
 #include <raymath.h>
+#include <rlgl.h>
+
+// Edges are expanded to quads and vertices to circles in the vertex shader,
+// so the whole net is a few instanced draw calls.
+static const char *netVertexShader = R"(
+#version 330
+in vec3 vertexPosition;
+in vec4 instanceData;
+uniform mat4 mvp;
+uniform vec2 position;
+uniform float scale;
+uniform float width;
+uniform int shape;
+uniform vec4 color;
+uniform vec4 altColor;
+out vec4 fragColor;
+
+void main()
+{
+    vec2 a = position + scale*vec2(instanceData.x, -instanceData.y);
+    vec2 p;
+    fragColor = color;
+    if (shape == 0) {
+        // Template quad: x runs along the edge, y across it.
+        vec2 b = position + scale*vec2(instanceData.z, -instanceData.w);
+        vec2 dir = b - a;
+        float len = length(dir);
+        dir = len > 0.0 ? dir/len: vec2(1, 0);
+        p = mix(a, b, vertexPosition.x) + vec2(-dir.y, dir.x)*vertexPosition.y*width*0.5;
+    } else {
+        // Template circle of unit radius, z holds the internal flag.
+        p = a + vertexPosition.xy*width;
+        if (instanceData.z > 0.5) fragColor = altColor;
+    }
+    gl_Position = mvp*vec4(p, 0, 1);
+}
+)";
+static const char *netFragmentShader = R"(
+#version 330
+in vec4 fragColor;
+out vec4 finalColor;
+
+void main()
+{
+    finalColor = fragColor;
+}
+)";
+
+// The template quad is 6 vertices and the circle 16 triangles. They get
+// their own buffers, as rlDrawVertexArrayInstanced always starts at the
+// first vertex and ignores its offset.
+#define QUAD_VERTICES 6
+#define CIRCLE_SEGMENTS 16
+#define CIRCLE_VERTICES (3*CIRCLE_SEGMENTS)
 
 TriangleNet::TriangleNet()
 {
 
 }
-void TriangleNet::Clear()
+void TriangleNet::InstanceBuffer::Set(int i, Vector4 instance)
 {
-    vertices.clear();
-    vertexToIndex.clear();
-    indices.clear();
-    indexToNeighbors.clear();
+    instances[i] = instance;
+    dirtyBegin = dirtyBegin < dirtyEnd ? min(dirtyBegin, i): i;
+    dirtyEnd = max(dirtyEnd, i+1);
 }
-void TriangleNet::AddTriangles(vector<Vector2> triangles)
+void TriangleNet::InstanceBuffer::Add(Vector4 instance)
 {
-    // Iterate every triangle.
-    for (int i = 0; i < triangles.size(); i += 3) {
-        for (int j = 0; j < 3; j++) { 
-            Vector2 vertex = triangles[i+j];
-            string key = GetVertexKey(vertex);
-            // Add a new vertex if this key is not present.
-            if (vertexToIndex.find(key) == vertexToIndex.end()) {
-                vertices.push_back(vertex);
-                vertexToIndex[key] = vertices.size()-1;
-            } 
-            indices.push_back(vertexToIndex[key]);
-        }
+    instances.push_back(instance);
+    Set(instances.size() - 1, instance);
+}
+void TriangleNet::InstanceBuffer::Remove(int i)
+{
+    Vector4 last = instances.back();
+    instances.pop_back();
+    if (i < instances.size()) Set(i, last);
+}
+void TriangleNet::RebuildRenderCache()
+{
+    for (int i = 0; i < 2; i++) {
+        edgeBuffers[i].instances.clear();
+        edgeKeys[i].clear();
+    }
+    edgeSlots.clear();
+    pointBuffer.instances.clear();
+    vertexLabels.clear();
 
-        // Count the number of times each edge is added.
-        for (int j = indices.size()-3; j < indices.size(); j++) {
-            for (int k = indices.size()-3; k < indices.size(); k++) {
-                if (j == k) continue;
-                indexToNeighbors[indices[j]][indices[k]] += 1;
+    for (auto &kv1: indexToNeighbors) {
+        for (auto &kv2: kv1.second) {
+            if (kv1.first < kv2.first) UpdateEdge(kv1.first, kv2.first);
+        }
+    }
+    // From here on the cache follows the log.
+    recordBoundaryLog = true;
+}
+void TriangleNet::UpdateRenderCache()
+{
+    // Clear does not go through the log, so everything is built again.
+    if (cacheClears != clears) {
+        cacheClears = clears;
+        RebuildRenderCache();
+    } else {
+        for (BoundaryEdit &edit: boundaryLog) {
+            UpdateEdge(edit.u, edit.v);
+            for (int w: { edit.u, edit.v }) {
+                if (w < pointBuffer.instances.size())
+                    pointBuffer.Set(w, { vertices[w].x, vertices[w].y, IsVertexInternal(w) ? 1.0f: 0.0f, 0 });
             }
         }
     }
+    ClearBoundaryLog();
+
+    // Vertices are only ever appended.
+    for (int i = pointBuffer.instances.size(); i < vertices.size(); i++) {
+        pointBuffer.Add({ vertices[i].x, vertices[i].y, IsVertexInternal(i) ? 1.0f: 0.0f, 0 });
+        vertexLabels.push_back(TextFormat("%d", i));
+    }
 }
-bool TriangleNet::IsEdgeInternal(int u, int v)
+void TriangleNet::UpdateEdge(int u, int v)
 {
-    return indexToNeighbors[u][v] != 1;
+    // Every edge enters and leaves the net through the boundary, so the
+    // log names every edge that appeared, disappeared or changed color.
+    int count = GetEdgeCount(u, v);
+    int color = count == 0 ? -1: count != 1;
+    uint64_t key = GetEdgeKey(u, v);
+    auto it = edgeSlots.find(key);
+    int current = it == edgeSlots.end() ? -1: it->second.first;
+    if (color == current) return;
+
+    if (current >= 0) {
+        int slot = it->second.second;
+        vector<uint64_t> &keys = edgeKeys[current];
+        edgeSlots.erase(it);
+        edgeBuffers[current].Remove(slot);
+        keys[slot] = keys.back();
+        keys.pop_back();
+        if (slot < keys.size()) edgeSlots[keys[slot]].second = slot;
+    }
+    if (color >= 0) {
+        Vector2 pos1 = vertices[key >> 32];
+        Vector2 pos2 = vertices[key & 0xffffffff];
+        edgeSlots[key] = { color, (int)edgeKeys[color].size() };
+        edgeKeys[color].push_back(key);
+        edgeBuffers[color].Add({ pos1.x, pos1.y, pos2.x, pos2.y });
+    }
 }
-bool TriangleNet::IsVertexInternal(int u)
+void TriangleNet::UploadRenderCache()
 {
-    for (auto kv: indexToNeighbors[u]) {
-        if (kv.second < 2)
-            return false;
+    if (!IsShaderReady(shader)) {
+        if (shaderFailed) return;
+        // raylib hands back its default shader when compiling or linking
+        // fails, so that is how a failure shows up. Only try once.
+        shader = LoadShaderFromMemory(netVertexShader, netFragmentShader);
+        if (!IsShaderReady(shader) || shader.id == rlGetShaderIdDefault()) {
+            TraceLog(LOG_WARNING, "TRIANGLENET: Instanced shader unavailable, drawing with raylib shapes");
+            shader = {};
+            shaderFailed = true;
+            return;
+        }
+
+        Vector2 quad[QUAD_VERTICES] = {
+            { 0, -1 }, { 1, -1 }, { 1, 1 },
+            { 0, -1 }, { 1, 1 }, { 0, 1 }
+        };
+        vector<Vector2> circle;
+        for (int i = 0; i < CIRCLE_SEGMENTS; i++) {
+            float a1 = 2*PI*i/CIRCLE_SEGMENTS;
+            float a2 = 2*PI*(i+1)/CIRCLE_SEGMENTS;
+            circle.push_back({ 0, 0 });
+            circle.push_back({ cosf(a1), sinf(a1) });
+            circle.push_back({ cosf(a2), sinf(a2) });
+        }
+        quadVbo = rlLoadVertexBuffer(quad, sizeof(quad), false);
+        circleVbo = rlLoadVertexBuffer(circle.data(), circle.size()*sizeof(Vector2), false);
     }
+
+    int instanceLoc = GetShaderLocationAttrib(shader, "instanceData");
+    int positionLoc = GetShaderLocationAttrib(shader, "vertexPosition");
+    UploadInstances(edgeBuffers[0], quadVbo, positionLoc, instanceLoc);
+    UploadInstances(edgeBuffers[1], quadVbo, positionLoc, instanceLoc);
+    UploadInstances(pointBuffer, circleVbo, positionLoc, instanceLoc);
+}
+void TriangleNet::UploadInstances(InstanceBuffer &buffer, unsigned int templateVbo, int positionLoc, int instanceLoc)
+{
+    int count = buffer.instances.size();
+    if (count > buffer.capacity) {
+        // Grow to twice the size, so appending triangles rarely reallocates.
+        if (buffer.vao) rlUnloadVertexArray(buffer.vao);
+        if (buffer.vbo) rlUnloadVertexBuffer(buffer.vbo);
+        buffer.capacity = max(256, 2*count);
+        buffer.vao = rlLoadVertexArray();
+        rlEnableVertexArray(buffer.vao);
+
+        rlEnableVertexBuffer(templateVbo);
+        rlSetVertexAttribute(positionLoc, 2, RL_FLOAT, false, 0, 0);
+        rlEnableVertexAttribute(positionLoc);
+
+        buffer.vbo = rlLoadVertexBuffer(nullptr, buffer.capacity*sizeof(Vector4), true);
+        rlSetVertexAttribute(instanceLoc, 4, RL_FLOAT, false, 0, 0);
+        rlEnableVertexAttribute(instanceLoc);
+        rlSetVertexAttributeDivisor(instanceLoc, 1);
+        rlDisableVertexArray();
+        buffer.dirtyBegin = 0;
+        buffer.dirtyEnd = count;
+    }
+    buffer.dirtyEnd = min(buffer.dirtyEnd, count);
+    if (buffer.dirtyBegin < buffer.dirtyEnd) {
+        rlUpdateVertexBuffer(buffer.vbo, &buffer.instances[buffer.dirtyBegin],
+            (buffer.dirtyEnd - buffer.dirtyBegin)*sizeof(Vector4), buffer.dirtyBegin*sizeof(Vector4));
+    }
+    buffer.dirtyBegin = buffer.dirtyEnd = 0;
+}
+bool TriangleNet::DrawRenderCache(Color external, Color internal)
+{
+    UploadRenderCache();
+    if (!IsShaderReady(shader)) return false;
+
+    // Flush whatever raylib has batched so far to keep the draw order.
+    rlDrawRenderBatchActive();
+    Matrix mvp = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+    Vector4 externalColor = ColorNormalize(external);
+    Vector4 internalColor = ColorNormalize(internal);
+    float lineWidth = 1.0f;
+    float pointRadius = 3.0f;
+    int lineShape = 0;
+    int pointShape = 1;
+    rlEnableShader(shader.id);
+    SetShaderValueMatrix(shader, GetShaderLocation(shader, "mvp"), mvp);
+    SetShaderValue(shader, GetShaderLocation(shader, "position"), &position, SHADER_UNIFORM_VEC2);
+    SetShaderValue(shader, GetShaderLocation(shader, "scale"), &scale, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(shader, GetShaderLocation(shader, "altColor"), &internalColor, SHADER_UNIFORM_VEC4);
+
+    SetShaderValue(shader, GetShaderLocation(shader, "width"), &lineWidth, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(shader, GetShaderLocation(shader, "shape"), &lineShape, SHADER_UNIFORM_INT);
+    for (int i = 0; i < 2; i++) {
+        if (edgeBuffers[i].instances.empty()) continue;
+        SetShaderValue(shader, GetShaderLocation(shader, "color"), i ? &internalColor: &externalColor, SHADER_UNIFORM_VEC4);
+        rlEnableVertexArray(edgeBuffers[i].vao);
+        rlDrawVertexArrayInstanced(0, QUAD_VERTICES, edgeBuffers[i].instances.size());
+    }
+    if (!pointBuffer.instances.empty()) {
+        SetShaderValue(shader, GetShaderLocation(shader, "width"), &pointRadius, SHADER_UNIFORM_FLOAT);
+        SetShaderValue(shader, GetShaderLocation(shader, "shape"), &pointShape, SHADER_UNIFORM_INT);
+        SetShaderValue(shader, GetShaderLocation(shader, "color"), &externalColor, SHADER_UNIFORM_VEC4);
+        rlEnableVertexArray(pointBuffer.vao);
+        rlDrawVertexArrayInstanced(0, CIRCLE_VERTICES, pointBuffer.instances.size());
+    }
+
+    rlDisableVertexArray();
+    rlDisableShader();
     return true;
 }
-string TriangleNet::GetVertexKey(Vector2 vert)
+void TriangleNet::UnloadRenderCache()
 {
-    return string(TextFormat("%3.3f,%3.3f", vert.x, vert.y));
+    for (InstanceBuffer *buffer: { &edgeBuffers[0], &edgeBuffers[1], &pointBuffer }) {
+        if (buffer->vao) rlUnloadVertexArray(buffer->vao);
+        if (buffer->vbo) rlUnloadVertexBuffer(buffer->vbo);
+        buffer->vao = buffer->vbo = 0;
+        buffer->capacity = 0;
+    }
+    if (quadVbo) rlUnloadVertexBuffer(quadVbo);
+    if (circleVbo) rlUnloadVertexBuffer(circleVbo);
+    if (IsShaderReady(shader)) UnloadShader(shader);
+    quadVbo = circleVbo = 0;
+    shader = {};
+    shaderFailed = false;
 }
 void TriangleNet::Draw(Color external, Color internal)
 {
-    for (int i = 0; i < indices.size(); i += 3) {
-        for (int j = 0; j < 3; j++) {
-            int i1 = indices[i+j];
-            int i2 = indices[i+(j+1)%3];
-            Vector2 v1 = Transform(vertices[i1]);
-            Vector2 v2 = Transform(vertices[i2]);
-            DrawLineV(v1, v2, IsEdgeInternal(i1, i2) ? internal: external);
+    UpdateRenderCache();
+    if (DrawRenderCache(external, internal)) return;
+
+    // Without shaders fall back to raylib lines, still one per edge.
+    for (int i = 0; i < 2; i++) {
+        for (Vector4 edge: edgeBuffers[i].instances) {
+            DrawLineV(Transform({ edge.x, edge.y }), Transform({ edge.z, edge.w }), i ? internal: external);
         }
     }
-    for (int i = 0; i < vertices.size(); i++) {
-        DrawCircleV(Transform(vertices[i]), 3, IsVertexInternal(i) ? internal: external);
+    for (Vector4 point: pointBuffer.instances) {
+        DrawCircleV(Transform({ point.x, point.y }), 3, point.z > 0.5f ? internal: external);
     }
 }
 void TriangleNet::DrawPolygon(vector<Vector2> verts, Color color, int until)
@@ -85,23 +299,38 @@ void TriangleNet::DrawPolygon(vector<Vector2> verts, Color color, int until)
 }
 void TriangleNet::DrawLabels(float size, Color color)
 {
+    UpdateRenderCache();
+
+    // Skip labels that are off screen.
+    Rectangle view = { -size, -size, GetScreenWidth() + 2*size, GetScreenHeight() + 2*size };
     for (int i = 0; i < vertices.size(); i++) {
         Vector2 pos = Transform(vertices[i]);
-        const char *text = TextFormat("%d\n", i);
-        DrawText(text, pos.x, pos.y, size, color);
-    }
-    // Draw all edge counters.
-    for (auto kv1: indexToNeighbors) {
-        for (auto kv2: kv1.second) {
-            if (kv2.second == 0) continue;
-            Vector2 pos1 = vertices[kv1.first];
-            Vector2 pos2 = vertices[kv2.first];
-            Vector2 dir = Vector2Scale(Vector2Subtract(pos2, pos1), 0.3f);
-            Vector2 textPos = Transform(Vector2Add(pos1, dir));
-            DrawText(TextFormat("%d", kv2.second), textPos.x, textPos.y, size*0.5, color);
+        if (!CheckCollisionPointRec(pos, view)) continue;
+        DrawText(vertexLabels[i].c_str(), pos.x, pos.y, size, color);
+    }
+    // Draw the edge counters near both ends of every edge.
+    for (int i = 0; i < 2; i++) {
+        for (uint64_t key: edgeKeys[i]) {
+            int ends[2] = { (int)(key >> 32), (int)(key & 0xffffffff) };
+            for (int j = 0; j < 2; j++) {
+                Vector2 pos1 = vertices[ends[j]];
+                Vector2 pos2 = vertices[ends[1-j]];
+                Vector2 dir = Vector2Scale(Vector2Subtract(pos2, pos1), 0.3f);
+                Vector2 textPos = Transform(Vector2Add(pos1, dir));
+                if (!CheckCollisionPointRec(textPos, view)) continue;
+                int count = i ? GetEdgeCount(ends[0], ends[1]): 1;
+                DrawText(GetCountLabel(count), textPos.x, textPos.y, size*0.5, color);
+            }
         }
     }
 }
+const char *TriangleNet::GetCountLabel(int count)
+{
+    while (countLabels.size() <= count) {
+        countLabels.push_back(TextFormat("%d", (int)countLabels.size()));
+    }
+    return countLabels[count].c_str();
+}
 Vector2 TriangleNet::Transform(Vector2 vert)
 {
     return Vector2Add(Vector2Scale({ vert.x, -vert.y }, scale), position);
@@ -123,39 +352,4 @@ Vector2 TriangleNet::GetNearestVertex(Vector2 pos, float dist)
         }
     }
     return minDist < dist ? minVert: pos;
-}
-vector<Vector2> TriangleNet::GetPolygon()
-{
-    // Find starting vertex.
-    int currentVertex = 0;
-    for (int i=0; i < vertices.size(); i++) {
-        if (!IsVertexInternal(i)) {
-            currentVertex = i;
-            break;
-        }
-    }
-    
-    // Now traverse all verts starting from this one,
-    // ignoring those we have already seen.
-    unordered_map<int, bool> seen;
-    vector<Vector2> list;
-    
-    for (int i = 0; i < vertices.size(); i++){ 
-        seen[currentVertex] = true;
-        list.push_back(vertices[currentVertex]);
-
-        int nextVertex = -1;
-        for (auto kv: indexToNeighbors[currentVertex]) {
-            if (kv.second == 1 && !seen[kv.first]) {
-                nextVertex = kv.first;
-                break;
-            }
-        }
-        if (nextVertex == -1) {
-            break;
-        }
-        currentVertex = nextVertex;
-    }
-
-    return list;
 }
\ No newline at end of file
@@ -1,43 +1,81 @@
 #ifndef TRIANGLE_NET_H
 #define TRIANGLE_NET_H
 
+#include "TriangleNetBase.h"
 #include <raylib.h>
 #include <vector>
-#include <unordered_map>
 #include <string>
+#include <unordered_map>
 using namespace std;
 
 // A triangle net class is used visualise the triangle merging problem
 // and to turn triangles into polygons (list of vertices).
-class TriangleNet
+// The welding and boundary logic lives in TriangleNetBase, this is the
+// 2D instantiation with the drawing on top.
+class TriangleNet: public TriangleNetBase<Vector2>
 {
 private:
+    // Instances for one draw call and their buffer on the GPU. Only the
+    // range that changed since the last upload is sent again.
+    struct InstanceBuffer
+    {
+        vector<Vector4> instances;
+        unsigned int vao = 0;
+        unsigned int vbo = 0;
+        int capacity = 0;
+        int dirtyBegin = 0;
+        int dirtyEnd = 0;
+
+        void Set(int i, Vector4 instance);
+        void Add(Vector4 instance);
+        // Moves the last instance into the freed slot.
+        void Remove(int i);
+    };
+
+    // Retained draw data. Edges are stored once as (x1, y1, x2, y2) per
+    // color, points as (x, y, internal, 0). After the first build the
+    // cache follows the boundary log, which it consumes, so an edit only
+    // touches the edges and points it changed.
+    unsigned int cacheClears = -1;
+    InstanceBuffer edgeBuffers[2];
+    InstanceBuffer pointBuffer;
+    vector<uint64_t> edgeKeys[2];
+    // Edge key to (color, slot) in the buffers above.
+    unordered_map<uint64_t, pair<int, int>> edgeSlots;
+    vector<string> vertexLabels;
+    vector<string> countLabels;
+
+    // GPU side of the cache, drawn as instanced quads and circles.
+    Shader shader = {};
+    bool shaderFailed = false;
+    unsigned int quadVbo = 0;
+    unsigned int circleVbo = 0;
+
+    void RebuildRenderCache();
+    void UpdateRenderCache();
+    void UpdateEdge(int u, int v);
+    void UploadRenderCache();
+    void UploadInstances(InstanceBuffer &buffer, unsigned int templateVbo, int positionLoc, int instanceLoc);
+    bool DrawRenderCache(Color external, Color internal);
+    const char *GetCountLabel(int count);
 
 public:
     Vector2 position = {};
     float scale = 100.0f;
 
-    vector<Vector2> vertices;
-    vector<int> indices;
-    unordered_map<string, int> vertexToIndex;
-    unordered_map<int, unordered_map<int, int>> indexToNeighbors;
-    
     TriangleNet();
-    void Clear();
-    // Load the data from a plain triangle list.
-    // Triangles are then merged by distance and indexed.
-    void AddTriangles(vector<Vector2> triangles);
-    bool IsEdgeInternal(int u, int v);
-    bool IsVertexInternal(int u);
-    vector<int> GetPolygonRecursive(int currentVertex, unordered_map<int, bool> &seen);
-    vector<Vector2> GetPolygon();
+    // Free the GPU buffers, needs the window to still be open.
+    void UnloadRenderCache();
     void Draw(Color internal, Color external);
     void DrawPolygon(vector<Vector2> verts, Color color, int until=-1);
     void DrawLabels(float size, Color color);
-    string GetVertexKey(Vector2 vert);
     Vector2 Transform(Vector2 vert);
     Vector2 InvTransform(Vector2 vert);
     Vector2 GetNearestVertex(Vector2 pos, float dist);
 };
 
+typedef TriangleNetBase<Vector3> TriangleNet3D;
+typedef TriangleNetBase<Vector2d> TriangleNet2DDouble;
+typedef TriangleNetBase<Vector3d> TriangleNet3DDouble;
+
 #endif
\ No newline at end of file
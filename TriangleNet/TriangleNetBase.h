@@ -0,0 +1,529 @@
+#ifndef TRIANGLE_NET_BASE_H
+#define TRIANGLE_NET_BASE_H
+
+#include <raylib.h>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include <cmath>
+using namespace std;
+
+// Double precision vertices, raylib only has float ones.
+struct Vector2d
+{
+    double x;
+    double y;
+};
+struct Vector3d
+{
+    double x;
+    double y;
+    double z;
+};
+
+// Vertices are merged when they fall in the same cell of a grid,
+// so the key is the vertex quantized to integers.
+template<int N>
+struct VertexKey
+{
+    int64_t v[N];
+
+    bool operator==(const VertexKey &other) const
+    {
+        for (int i = 0; i < N; i++) {
+            if (v[i] != other.v[i]) return false;
+        }
+        return true;
+    }
+};
+template<int N>
+struct VertexKeyHash
+{
+    size_t operator()(const VertexKey<N> &key) const
+    {
+        // FNV style mixing of the components, unrolled since N is fixed.
+        uint64_t hash = 14695981039346656037ull;
+        for (int i = 0; i < N; i++) {
+            hash = (hash ^ (uint64_t)key.v[i]) * 1099511628211ull;
+        }
+        return hash ^ (hash >> 32);
+    }
+};
+
+// Per vertex type information. Float vertices are merged at three decimals,
+// like the old "%3.3f" string keys, double vertices at six decimals.
+template<typename V> struct VertexTraits;
+
+template<> struct VertexTraits<Vector2>
+{
+    typedef float Scalar;
+    static const int dimension = 2;
+    static VertexKey<2> Quantize(Vector2 v)
+    {
+        return {{ llround(v.x*1e3), llround(v.y*1e3) }};
+    }
+};
+template<> struct VertexTraits<Vector3>
+{
+    typedef float Scalar;
+    static const int dimension = 3;
+    static VertexKey<3> Quantize(Vector3 v)
+    {
+        return {{ llround(v.x*1e3), llround(v.y*1e3), llround(v.z*1e3) }};
+    }
+};
+template<> struct VertexTraits<Vector2d>
+{
+    typedef double Scalar;
+    static const int dimension = 2;
+    static VertexKey<2> Quantize(Vector2d v)
+    {
+        return {{ llround(v.x*1e6), llround(v.y*1e6) }};
+    }
+};
+template<> struct VertexTraits<Vector3d>
+{
+    typedef double Scalar;
+    static const int dimension = 3;
+    static VertexKey<3> Quantize(Vector3d v)
+    {
+        return {{ llround(v.x*1e6), llround(v.y*1e6), llround(v.z*1e6) }};
+    }
+};
+
+// A single change to the boundary, an edge that started or stopped
+// being used by exactly one triangle.
+struct BoundaryEdit
+{
+    int u;
+    int v;
+    bool added;
+};
+
+// The welding, adjacency and boundary part of a triangle net,
+// for any vertex type that has VertexTraits.
+template<typename V>
+class TriangleNetBase
+{
+public:
+    typedef VertexTraits<V> Traits;
+    typedef VertexKey<Traits::dimension> Key;
+
+private:
+    int AddVertex(const V &vertex);
+    void AddTriangle(int a, int b, int c);
+    void AddEdgeUse(int u, int v, int delta);
+    void AddBoundaryEdge(int u, int v);
+    void RemoveBoundaryEdge(int u, int v);
+    int FindTriangle(int a, int b, int c);
+    Vector3d GetTriangleNormal(int triangle);
+
+public:
+    vector<V> vertices;
+    vector<int> indices;
+    unordered_map<Key, int, VertexKeyHash<Traits::dimension>> vertexToIndex;
+    unordered_map<int, unordered_map<int, int>> indexToNeighbors;
+
+    // The boundary is kept up to date on every insertion and removal.
+    // With recordBoundaryLog set, edits are also appended to the log,
+    // which is cleared by whoever consumes it. Off by default, so nets
+    // that nobody follows do not grow a log.
+    vector<vector<int>> boundaryNeighbors;
+    vector<vector<int>> vertexToTriangles;
+    unordered_set<int> boundaryVertices;
+    vector<BoundaryEdit> boundaryLog;
+    bool recordBoundaryLog = false;
+    // Edges used by more than two triangles.
+    unordered_set<uint64_t> nonManifoldEdges;
+    // Bumped by Clear, which empties the log instead of recording edits.
+    unsigned int clears = 0;
+
+    void Clear();
+    // Load the data from a plain triangle list.
+    // Triangles are then merged by distance and indexed.
+    void AddTriangles(const vector<V> &triangles);
+    void AddTriangles(const V *triangles, size_t count);
+    // Load indexed triangles straight from the given buffers.
+    // When indices is null every three vertices form a triangle.
+    // Triangles with an index past vertexCount are skipped.
+    template<typename I>
+    void AddIndexedTriangles(const V *verts, size_t vertexCount, const I *idx, size_t indexCount);
+    // Weld a raylib mesh without copying its buffers, only for Vector3.
+    void AddMesh(const Mesh &mesh);
+    // Remove triangles with the same (merged) vertices, in any order.
+    void RemoveTriangles(const vector<V> &triangles);
+    void ClearBoundaryLog();
+    int GetEdgeCount(int u, int v);
+    bool IsEdgeInternal(int u, int v);
+    bool IsVertexInternal(int u);
+    vector<V> GetPolygon();
+    // Returns every boundary loop as a list of vertex indices.
+    vector<vector<int>> GetBoundaryLoops();
+    // Calls visit with each boundary loop in turn, without keeping them.
+    template<typename F>
+    void WalkBoundaryLoops(F visit);
+    // Returns boundary and non-manifold edges as index pairs. These are
+    // only the topological features, the shape of the surface is ignored.
+    vector<pair<int, int>> GetFeatureEdges();
+    // Also returns the edges where the normals of the two triangles differ
+    // by more than creaseAngle degrees, only for 3D vertices. Triangles
+    // have to be wound consistently.
+    vector<pair<int, int>> GetFeatureEdges(double creaseAngle);
+    Key GetVertexKey(const V &vert);
+    // Key of an undirected edge, the smaller index in the high half.
+    static uint64_t GetEdgeKey(int u, int v);
+};
+
+template<typename V>
+void TriangleNetBase<V>::Clear()
+{
+    vertices.clear();
+    vertexToIndex.clear();
+    indices.clear();
+    indexToNeighbors.clear();
+    boundaryNeighbors.clear();
+    vertexToTriangles.clear();
+    boundaryVertices.clear();
+    boundaryLog.clear();
+    nonManifoldEdges.clear();
+    clears++;
+}
+template<typename V>
+int TriangleNetBase<V>::AddVertex(const V &vertex)
+{
+    // Add a new vertex if this key is not present.
+    auto inserted = vertexToIndex.insert({ GetVertexKey(vertex), (int)vertices.size() });
+    if (inserted.second) {
+        vertices.push_back(vertex);
+        boundaryNeighbors.emplace_back();
+        vertexToTriangles.emplace_back();
+    }
+    return inserted.first->second;
+}
+template<typename V>
+void TriangleNetBase<V>::AddTriangle(int a, int b, int c)
+{
+    indices.push_back(a);
+    indices.push_back(b);
+    indices.push_back(c);
+
+    // Count the number of times each edge is added.
+    int triangle = indices.size()/3 - 1;
+    for (int j = 0; j < 3; j++) {
+        int u = indices[3*triangle+j];
+        int v = indices[3*triangle+(j+1)%3];
+        AddEdgeUse(u, v, 1);
+        vertexToTriangles[u].push_back(triangle);
+    }
+}
+template<typename V>
+void TriangleNetBase<V>::AddTriangles(const vector<V> &triangles)
+{
+    AddTriangles(triangles.data(), triangles.size());
+}
+template<typename V>
+void TriangleNetBase<V>::AddTriangles(const V *triangles, size_t count)
+{
+    // Iterate every triangle.
+    for (size_t i = 0; i+2 < count; i += 3) {
+        int a = AddVertex(triangles[i]);
+        int b = AddVertex(triangles[i+1]);
+        int c = AddVertex(triangles[i+2]);
+        AddTriangle(a, b, c);
+    }
+}
+template<typename V>
+template<typename I>
+void TriangleNetBase<V>::AddIndexedTriangles(const V *verts, size_t vertexCount, const I *idx, size_t indexCount)
+{
+    if (!idx) {
+        AddTriangles(verts, vertexCount);
+        return;
+    }
+    // Each source vertex is only quantized once.
+    vector<int> welded(vertexCount, -1);
+    for (size_t i = 0; i+2 < indexCount; i += 3) {
+        if ((size_t)idx[i] >= vertexCount || (size_t)idx[i+1] >= vertexCount || (size_t)idx[i+2] >= vertexCount)
+            continue;
+        int tri[3];
+        for (int j = 0; j < 3; j++) {
+            size_t source = idx[i+j];
+            if (welded[source] < 0) welded[source] = AddVertex(verts[source]);
+            tri[j] = welded[source];
+        }
+        AddTriangle(tri[0], tri[1], tri[2]);
+    }
+}
+template<typename V>
+void TriangleNetBase<V>::AddMesh(const Mesh &mesh)
+{
+    static_assert(is_same<V, Vector3>::value, "AddMesh needs a Vector3 triangle net");
+    const V *verts = (const V *)mesh.vertices;
+    size_t indexCount = mesh.indices ? (size_t)mesh.triangleCount*3: mesh.vertexCount;
+    AddIndexedTriangles(verts, mesh.vertexCount, mesh.indices, indexCount);
+}
+template<typename V>
+void TriangleNetBase<V>::RemoveTriangles(const vector<V> &triangles)
+{
+    for (size_t i = 0; i+2 < triangles.size(); i += 3) {
+        int tri[3];
+        bool found = true;
+        for (int j = 0; j < 3 && found; j++) {
+            auto it = vertexToIndex.find(GetVertexKey(triangles[i+j]));
+            found = it != vertexToIndex.end();
+            if (found) tri[j] = it->second;
+        }
+        int triangle = found ? FindTriangle(tri[0], tri[1], tri[2]): -1;
+        if (triangle < 0) continue;
+
+        for (int j = 0; j < 3; j++) {
+            int u = indices[3*triangle+j];
+            int v = indices[3*triangle+(j+1)%3];
+            AddEdgeUse(u, v, -1);
+            vector<int> &list = vertexToTriangles[u];
+            list.erase(find(list.begin(), list.end(), triangle));
+        }
+
+        // Move the last triangle into the freed slot.
+        int last = indices.size()/3 - 1;
+        if (triangle != last) {
+            for (int j = 0; j < 3; j++) {
+                indices[3*triangle+j] = indices[3*last+j];
+                vector<int> &list = vertexToTriangles[indices[3*triangle+j]];
+                *find(list.begin(), list.end(), last) = triangle;
+            }
+        }
+        indices.resize(3*last);
+    }
+}
+template<typename V>
+int TriangleNetBase<V>::FindTriangle(int a, int b, int c)
+{
+    // Only the triangles around one vertex have to be checked.
+    for (int triangle: vertexToTriangles[a]) {
+        int *tri = &indices[3*triangle];
+        int key[3] = { a, b, c };
+        if (is_permutation(tri, tri+3, key))
+            return triangle;
+    }
+    return -1;
+}
+template<typename V>
+Vector3d TriangleNetBase<V>::GetTriangleNormal(int triangle)
+{
+    const V &a = vertices[indices[3*triangle]];
+    const V &b = vertices[indices[3*triangle+1]];
+    const V &c = vertices[indices[3*triangle+2]];
+    Vector3d ab = { (double)b.x - a.x, (double)b.y - a.y, (double)b.z - a.z };
+    Vector3d ac = { (double)c.x - a.x, (double)c.y - a.y, (double)c.z - a.z };
+    return { ab.y*ac.z - ab.z*ac.y, ab.z*ac.x - ab.x*ac.z, ab.x*ac.y - ab.y*ac.x };
+}
+template<typename V>
+uint64_t TriangleNetBase<V>::GetEdgeKey(int u, int v)
+{
+    return u < v ? ((uint64_t)u << 32) | v: ((uint64_t)v << 32) | u;
+}
+template<typename V>
+void TriangleNetBase<V>::AddEdgeUse(int u, int v, int delta)
+{
+    if (u == v) return;
+    int before = GetEdgeCount(u, v);
+    int count = before + delta;
+    if (count == 0) {
+        indexToNeighbors[u].erase(v);
+        indexToNeighbors[v].erase(u);
+    } else {
+        indexToNeighbors[u][v] = count;
+        indexToNeighbors[v][u] = count;
+    }
+
+    // An edge is on the boundary when it is used by exactly one triangle.
+    if (before == 1 && count != 1) {
+        RemoveBoundaryEdge(u, v);
+    } else if (before != 1 && count == 1) {
+        AddBoundaryEdge(u, v);
+    }
+    if (before <= 2 && count > 2) {
+        nonManifoldEdges.insert(GetEdgeKey(u, v));
+    } else if (before > 2 && count <= 2) {
+        nonManifoldEdges.erase(GetEdgeKey(u, v));
+    }
+}
+template<typename V>
+void TriangleNetBase<V>::AddBoundaryEdge(int u, int v)
+{
+    for (int w: { u, v }) {
+        if (boundaryNeighbors[w].empty()) boundaryVertices.insert(w);
+    }
+    boundaryNeighbors[u].push_back(v);
+    boundaryNeighbors[v].push_back(u);
+    if (recordBoundaryLog) boundaryLog.push_back({ u, v, true });
+}
+template<typename V>
+void TriangleNetBase<V>::RemoveBoundaryEdge(int u, int v)
+{
+    for (auto [w, other]: { pair(u, v), pair(v, u) }) {
+        vector<int> &list = boundaryNeighbors[w];
+        *find(list.begin(), list.end(), other) = list.back();
+        list.pop_back();
+        if (list.empty()) boundaryVertices.erase(w);
+    }
+    if (recordBoundaryLog) boundaryLog.push_back({ u, v, false });
+}
+template<typename V>
+void TriangleNetBase<V>::ClearBoundaryLog()
+{
+    boundaryLog.clear();
+}
+template<typename V>
+int TriangleNetBase<V>::GetEdgeCount(int u, int v)
+{
+    auto it = indexToNeighbors.find(u);
+    if (it == indexToNeighbors.end()) return 0;
+    auto it2 = it->second.find(v);
+    return it2 == it->second.end() ? 0: it2->second;
+}
+template<typename V>
+bool TriangleNetBase<V>::IsEdgeInternal(int u, int v)
+{
+    return GetEdgeCount(u, v) != 1;
+}
+template<typename V>
+bool TriangleNetBase<V>::IsVertexInternal(int u)
+{
+    return u >= boundaryNeighbors.size() || boundaryNeighbors[u].empty();
+}
+template<typename V>
+typename TriangleNetBase<V>::Key TriangleNetBase<V>::GetVertexKey(const V &vert)
+{
+    return Traits::Quantize(vert);
+}
+template<typename V>
+vector<V> TriangleNetBase<V>::GetPolygon()
+{
+    // Start from the lowest boundary vertex, only the boundary is walked.
+    if (boundaryVertices.empty()) {
+        return {};
+    }
+    int currentVertex = *min_element(boundaryVertices.begin(), boundaryVertices.end());
+
+    // Now traverse all verts starting from this one,
+    // ignoring those we have already seen.
+    unordered_map<int, bool> seen;
+    vector<V> list;
+
+    for (int i = 0; i < boundaryVertices.size(); i++){
+        seen[currentVertex] = true;
+        list.push_back(vertices[currentVertex]);
+
+        int nextVertex = -1;
+        for (int neighbor: boundaryNeighbors[currentVertex]) {
+            if (!seen[neighbor]) {
+                nextVertex = neighbor;
+                break;
+            }
+        }
+        if (nextVertex == -1) {
+            break;
+        }
+        currentVertex = nextVertex;
+    }
+
+    return list;
+}
+template<typename V>
+vector<vector<int>> TriangleNetBase<V>::GetBoundaryLoops()
+{
+    vector<vector<int>> loops;
+    WalkBoundaryLoops([&](const vector<int> &loop) { loops.push_back(loop); });
+    return loops;
+}
+template<typename V>
+template<typename F>
+void TriangleNetBase<V>::WalkBoundaryLoops(F visit)
+{
+    // Walk along boundary edges, marking each edge so it is only walked once.
+    unordered_set<uint64_t> used;
+    vector<int> starts(boundaryVertices.begin(), boundaryVertices.end());
+    sort(starts.begin(), starts.end());
+    vector<int> loop;
+
+    for (int start: starts) {
+        for (int neighbor: boundaryNeighbors[start]) {
+            if (used.count(GetEdgeKey(start, neighbor))) continue;
+
+            loop.assign(1, start);
+            used.insert(GetEdgeKey(start, neighbor));
+            int currentVertex = neighbor;
+
+            while (currentVertex != start) {
+                loop.push_back(currentVertex);
+                int nextVertex = -1;
+                for (int next: boundaryNeighbors[currentVertex]) {
+                    if (!used.count(GetEdgeKey(currentVertex, next))) {
+                        nextVertex = next;
+                        break;
+                    }
+                }
+                if (nextVertex == -1) {
+                    break;
+                }
+                used.insert(GetEdgeKey(currentVertex, nextVertex));
+                currentVertex = nextVertex;
+            }
+            visit(loop);
+        }
+    }
+}
+template<typename V>
+vector<pair<int, int>> TriangleNetBase<V>::GetFeatureEdges()
+{
+    vector<pair<int, int>> edges;
+    for (int u: boundaryVertices) {
+        for (int v: boundaryNeighbors[u]) {
+            if (u < v) edges.push_back({ u, v });
+        }
+    }
+    for (uint64_t key: nonManifoldEdges) {
+        edges.push_back({ (int)(key >> 32), (int)(key & 0xffffffff) });
+    }
+    return edges;
+}
+template<typename V>
+vector<pair<int, int>> TriangleNetBase<V>::GetFeatureEdges(double creaseAngle)
+{
+    static_assert(Traits::dimension == 3, "Crease edges need a 3D triangle net");
+    vector<pair<int, int>> edges = GetFeatureEdges();
+    double minCos = cos(creaseAngle*DEG2RAD);
+
+    // Only edges shared by exactly two triangles can be creases.
+    for (auto &entry: indexToNeighbors) {
+        int u = entry.first;
+        for (auto &neighbor: entry.second) {
+            int v = neighbor.first;
+            if (u > v || neighbor.second != 2) continue;
+
+            int shared[2];
+            int found = 0;
+            for (int triangle: vertexToTriangles[u]) {
+                int *tri = &indices[3*triangle];
+                if (found < 2 && (tri[0] == v || tri[1] == v || tri[2] == v))
+                    shared[found++] = triangle;
+            }
+            if (found < 2) continue;
+
+            Vector3d n1 = GetTriangleNormal(shared[0]);
+            Vector3d n2 = GetTriangleNormal(shared[1]);
+            double length = sqrt((n1.x*n1.x + n1.y*n1.y + n1.z*n1.z)*(n2.x*n2.x + n2.y*n2.y + n2.z*n2.z));
+            if (length == 0) continue;
+            double cosAngle = (n1.x*n2.x + n1.y*n2.y + n1.z*n2.z)/length;
+            if (cosAngle < minCos) edges.push_back({ u, v });
+        }
+    }
+    return edges;
+}
+
+#endif
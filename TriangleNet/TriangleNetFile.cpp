@@ -0,0 +1,353 @@
+#include "TriangleNetFile.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(TriangleNetFileHeader) % TRIANGLE_NET_FILE_ALIGN == 0, "Header must keep sections aligned");
+static_assert(sizeof(int) == sizeof(uint32_t), "Indices are written as 32 bit");
+
+static bool IsLittleEndian()
+{
+    uint32_t value = 1;
+    return *(uint8_t *)&value == 1;
+}
+
+TriangleNetWriter::~TriangleNetWriter()
+{
+    if (file) fclose(file);
+}
+bool TriangleNetWriter::Open(const char *path, uint32_t dimension, uint32_t scalarSize)
+{
+    if (!IsLittleEndian()) {
+        TraceLog(LOG_WARNING, "TRINET: Writing is only supported on little-endian hosts");
+        return false;
+    }
+    file = fopen(path, "wb");
+    if (!file) {
+        TraceLog(LOG_WARNING, "TRINET: [%s] Failed to open file for writing", path);
+        return false;
+    }
+    header = {};
+    memcpy(header.magic, TRIANGLE_NET_FILE_MAGIC, sizeof(header.magic));
+    header.version = TRIANGLE_NET_FILE_VERSION;
+    header.byteOrder = TRIANGLE_NET_FILE_BYTE_ORDER;
+    header.dimension = dimension;
+    header.scalarSize = scalarSize;
+    section = -1;
+    inSection = false;
+    position = 0;
+
+    // Reserve room for the header, it is written once all sections are known.
+    return Write(&header, sizeof(header));
+}
+bool TriangleNetWriter::Pad()
+{
+    static const char zeros[TRIANGLE_NET_FILE_ALIGN] = {};
+    size_t padding = (TRIANGLE_NET_FILE_ALIGN - position % TRIANGLE_NET_FILE_ALIGN) % TRIANGLE_NET_FILE_ALIGN;
+    return Write(zeros, padding);
+}
+bool TriangleNetWriter::BeginSection(int id)
+{
+    // Sections have to come in file order, skipped sections stay empty.
+    if (!file || id <= section || id >= SECTION_COUNT) return false;
+    if (!EndSection()) return false;
+    section = id;
+    inSection = true;
+    header.sections[id].offset = position;
+    header.sections[id].size = 0;
+    return true;
+}
+bool TriangleNetWriter::Write(const void *data, size_t bytes)
+{
+    if (!file) return false;
+    if (bytes > 0 && fwrite(data, 1, bytes, file) != bytes) {
+        TraceLog(LOG_WARNING, "TRINET: Failed to write %zu bytes", bytes);
+        return false;
+    }
+    position += bytes;
+    if (inSection) {
+        header.sections[section].size += bytes;
+    }
+    return true;
+}
+bool TriangleNetWriter::EndSection()
+{
+    if (!inSection) return true;
+    inSection = false;
+    return Pad();
+}
+bool TriangleNetWriter::Close()
+{
+    if (!file) return false;
+    bool ok = EndSection();
+
+    // Counts follow from the section sizes.
+    uint64_t vertexSize = (uint64_t)header.dimension*header.scalarSize;
+    uint64_t loopOffsetCount = header.sections[SECTION_LOOP_OFFSETS].size/sizeof(uint32_t);
+    header.vertexCount = vertexSize > 0 ? header.sections[SECTION_VERTICES].size/vertexSize: 0;
+    header.indexCount = header.sections[SECTION_INDICES].size/sizeof(uint32_t);
+    header.adjacencyCount = header.sections[SECTION_ADJ_NEIGHBORS].size/sizeof(uint32_t);
+    header.loopCount = loopOffsetCount > 0 ? loopOffsetCount - 1: 0;
+    header.loopVertexCount = header.sections[SECTION_LOOP_VERTICES].size/sizeof(uint32_t);
+
+    ok = ok && fseek(file, 0, SEEK_SET) == 0;
+    ok = ok && fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+    file = nullptr;
+    return ok;
+}
+
+// Collects 32 bit values and hands them to the writer in chunks,
+// so sections can be streamed without building them in memory.
+class TriangleNetChunkWriter
+{
+private:
+    TriangleNetWriter &writer;
+    vector<uint32_t> chunk;
+    bool ok = true;
+
+public:
+    TriangleNetChunkWriter(TriangleNetWriter &writer): writer(writer)
+    {
+        chunk.reserve(1 << 16);
+    }
+    void Put(uint32_t value)
+    {
+        chunk.push_back(value);
+        if (chunk.size() == chunk.capacity()) Flush();
+    }
+    bool Flush()
+    {
+        ok = ok && writer.Write(chunk.data(), chunk.size()*sizeof(uint32_t));
+        chunk.clear();
+        return ok;
+    }
+};
+
+template<typename V>
+bool SaveTriangleNet(TriangleNetBase<V> &net, const char *path)
+{
+    typedef VertexTraits<V> Traits;
+    static_assert(sizeof(V) == Traits::dimension*sizeof(typename Traits::Scalar), "Vertices are written as packed components");
+
+    TriangleNetWriter writer;
+    TriangleNetChunkWriter chunks(writer);
+    bool ok = writer.Open(path, Traits::dimension, sizeof(typename Traits::Scalar));
+    ok = ok && writer.BeginSection(SECTION_VERTICES);
+    ok = ok && writer.Write(net.vertices.data(), net.vertices.size()*sizeof(V));
+    ok = ok && writer.BeginSection(SECTION_INDICES);
+    ok = ok && writer.Write(net.indices.data(), net.indices.size()*sizeof(uint32_t));
+
+    // The neighbor maps are streamed as sorted CSR arrays, one pass per
+    // section, so only the neighbors of one vertex are held at a time.
+    vector<pair<int, int>> sorted;
+    auto getSorted = [&](int u) {
+        sorted.clear();
+        auto it = net.indexToNeighbors.find(u);
+        if (it != net.indexToNeighbors.end()) {
+            sorted.assign(it->second.begin(), it->second.end());
+        }
+        sort(sorted.begin(), sorted.end());
+    };
+    ok = ok && writer.BeginSection(SECTION_ADJ_OFFSETS);
+    uint32_t offset = 0;
+    chunks.Put(offset);
+    for (int u = 0; ok && u < net.vertices.size(); u++) {
+        auto it = net.indexToNeighbors.find(u);
+        offset += it != net.indexToNeighbors.end() ? it->second.size(): 0;
+        chunks.Put(offset);
+    }
+    ok = ok && chunks.Flush();
+    ok = ok && writer.BeginSection(SECTION_ADJ_NEIGHBORS);
+    for (int u = 0; ok && u < net.vertices.size(); u++) {
+        getSorted(u);
+        for (auto kv: sorted) chunks.Put(kv.first);
+    }
+    ok = ok && chunks.Flush();
+    ok = ok && writer.BeginSection(SECTION_ADJ_COUNTS);
+    for (int u = 0; ok && u < net.vertices.size(); u++) {
+        getSorted(u);
+        for (auto kv: sorted) chunks.Put(kv.second);
+    }
+    ok = ok && chunks.Flush();
+
+    // Loops are walked twice, once for their offsets and once to write them.
+    ok = ok && writer.BeginSection(SECTION_LOOP_OFFSETS);
+    offset = 0;
+    chunks.Put(offset);
+    net.WalkBoundaryLoops([&](const vector<int> &loop) {
+        offset += loop.size();
+        chunks.Put(offset);
+    });
+    ok = ok && chunks.Flush();
+    ok = ok && writer.BeginSection(SECTION_LOOP_VERTICES);
+    net.WalkBoundaryLoops([&](const vector<int> &loop) {
+        ok = ok && writer.Write(loop.data(), loop.size()*sizeof(uint32_t));
+    });
+    return writer.Close() && ok;
+}
+template bool SaveTriangleNet(TriangleNetBase<Vector2> &net, const char *path);
+template bool SaveTriangleNet(TriangleNetBase<Vector3> &net, const char *path);
+template bool SaveTriangleNet(TriangleNetBase<Vector2d> &net, const char *path);
+template bool SaveTriangleNet(TriangleNetBase<Vector3d> &net, const char *path);
+
+TriangleNetView::~TriangleNetView()
+{
+    Close();
+}
+bool TriangleNetView::Open(const char *path)
+{
+    Close();
+
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        TraceLog(LOG_WARNING, "TRINET: [%s] Failed to open file", path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(TriangleNetFileHeader)) {
+        dataSize = st.st_size;
+        data = mmap(nullptr, dataSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) data = nullptr;
+        mapped = data != nullptr;
+    }
+    close(fd);
+#else
+    // No mapping on Windows here, read the whole file instead.
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        TraceLog(LOG_WARNING, "TRINET: [%s] Failed to open file", path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    dataSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (dataSize >= sizeof(TriangleNetFileHeader)) {
+        data = malloc(dataSize);
+        if (data && fread(data, 1, dataSize, file) != dataSize) {
+            free(data);
+            data = nullptr;
+        }
+    }
+    fclose(file);
+#endif
+    if (!data) {
+        TraceLog(LOG_WARNING, "TRINET: [%s] Failed to load file", path);
+        Close();
+        return false;
+    }
+
+    header = (const TriangleNetFileHeader *)data;
+    bool valid = memcmp(header->magic, TRIANGLE_NET_FILE_MAGIC, sizeof(header->magic)) == 0 &&
+        header->version == TRIANGLE_NET_FILE_VERSION &&
+        header->byteOrder == TRIANGLE_NET_FILE_BYTE_ORDER &&
+        header->sections[SECTION_VERTICES].size == header->vertexCount*header->dimension*header->scalarSize;
+    for (int i = 0; valid && i < SECTION_COUNT; i++) {
+        TriangleNetFileSection section = header->sections[i];
+        valid = section.offset % TRIANGLE_NET_FILE_ALIGN == 0 &&
+            section.offset <= dataSize && section.size <= dataSize - section.offset;
+    }
+    valid = valid &&
+        header->sections[SECTION_ADJ_OFFSETS].size == (header->vertexCount + 1)*sizeof(uint32_t) &&
+        header->sections[SECTION_ADJ_NEIGHBORS].size == header->adjacencyCount*sizeof(uint32_t) &&
+        header->sections[SECTION_ADJ_COUNTS].size == header->adjacencyCount*sizeof(uint32_t) &&
+        header->sections[SECTION_LOOP_VERTICES].size == header->loopVertexCount*sizeof(uint32_t) &&
+        (header->sections[SECTION_LOOP_OFFSETS].size == (header->loopCount + 1)*sizeof(uint32_t) ||
+        (header->loopCount == 0 && header->sections[SECTION_LOOP_OFFSETS].size == 0));
+    if (valid) {
+        // Offset tables have to start at zero and end at their list size.
+        // The entries in between are checked when they are used.
+        const uint32_t *offsets = (const uint32_t *)GetSection(SECTION_ADJ_OFFSETS);
+        valid = offsets[0] == 0 && offsets[header->vertexCount] == header->adjacencyCount;
+        offsets = (const uint32_t *)GetSection(SECTION_LOOP_OFFSETS);
+        if (valid && header->sections[SECTION_LOOP_OFFSETS].size > 0)
+            valid = offsets[0] == 0 && offsets[header->loopCount] == header->loopVertexCount;
+    }
+    if (!valid) {
+        TraceLog(LOG_WARNING, "TRINET: [%s] Invalid or unsupported file", path);
+        Close();
+        return false;
+    }
+
+    vertexData = GetSection(SECTION_VERTICES);
+    indices = (const uint32_t *)GetSection(SECTION_INDICES);
+    adjOffsets = (const uint32_t *)GetSection(SECTION_ADJ_OFFSETS);
+    adjNeighbors = (const uint32_t *)GetSection(SECTION_ADJ_NEIGHBORS);
+    adjCounts = (const uint32_t *)GetSection(SECTION_ADJ_COUNTS);
+    loopOffsets = (const uint32_t *)GetSection(SECTION_LOOP_OFFSETS);
+    loopVertices = (const uint32_t *)GetSection(SECTION_LOOP_VERTICES);
+    return true;
+}
+void TriangleNetView::Close()
+{
+    if (data) {
+#ifndef _WIN32
+        if (mapped) munmap(data, dataSize);
+#else
+        free(data);
+#endif
+    }
+    data = nullptr;
+    dataSize = 0;
+    mapped = false;
+    header = nullptr;
+    vertexData = nullptr;
+    indices = adjOffsets = adjNeighbors = adjCounts = loopOffsets = loopVertices = nullptr;
+}
+const void *TriangleNetView::GetSection(int id)
+{
+    return (const char *)data + header->sections[id].offset;
+}
+int TriangleNetView::GetVertexCount()
+{
+    return header ? header->vertexCount: 0;
+}
+int TriangleNetView::GetLoopCount()
+{
+    return header ? header->loopCount: 0;
+}
+bool TriangleNetView::HasNeighbors(int u)
+{
+    return u >= 0 && u < GetVertexCount() && adjOffsets[u] <= adjOffsets[u+1] &&
+        adjOffsets[u+1] <= header->adjacencyCount;
+}
+int TriangleNetView::GetEdgeCount(int u, int v)
+{
+    if (!HasNeighbors(u)) return 0;
+    // Neighbor lists are sorted, so a binary search finds the edge.
+    const uint32_t *begin = adjNeighbors + adjOffsets[u];
+    const uint32_t *end = adjNeighbors + adjOffsets[u+1];
+    const uint32_t *it = lower_bound(begin, end, (uint32_t)v);
+    return (it != end && *it == (uint32_t)v) ? adjCounts[it - adjNeighbors]: 0;
+}
+bool TriangleNetView::IsEdgeInternal(int u, int v)
+{
+    return GetEdgeCount(u, v) != 1;
+}
+bool TriangleNetView::IsVertexInternal(int u)
+{
+    if (!HasNeighbors(u)) return true;
+    for (uint32_t i = adjOffsets[u]; i < adjOffsets[u+1]; i++) {
+        if (adjCounts[i] < 2)
+            return false;
+    }
+    return true;
+}
+const uint32_t *TriangleNetView::GetLoop(int loop, int *count)
+{
+    if (loop < 0 || loop >= GetLoopCount() || loopOffsets[loop] > loopOffsets[loop+1] ||
+        loopOffsets[loop+1] > header->loopVertexCount) {
+        *count = 0;
+        return nullptr;
+    }
+    *count = loopOffsets[loop+1] - loopOffsets[loop];
+    return loopVertices + loopOffsets[loop];
+}
@@ -0,0 +1,162 @@
+#ifndef TRIANGLE_NET_FILE_H
+#define TRIANGLE_NET_FILE_H
+
+#include "TriangleNet.h"
+#include <cstdint>
+#include <cstdio>
+
+// Binary format for a welded triangle net, so the welding, indexing and
+// adjacency counting only has to be done once per model.
+//
+// The file is little-endian and every section starts on a 64 byte boundary.
+// It can be mapped into memory and used in place without any parsing:
+//
+//   header | vertices | indices | adjacency offsets | adjacency neighbors
+//          | adjacency counts | loop offsets | loop vertices
+//
+// Adjacency is stored in CSR form. The neighbors of vertex u are found at
+// neighbors[offsets[u]] up to neighbors[offsets[u+1]], sorted by index,
+// and counts holds the edge use count at the same position.
+// Boundary loops are stored the same way, as lists of vertex indices.
+
+#define TRIANGLE_NET_FILE_MAGIC "TRINET\0"
+#define TRIANGLE_NET_FILE_VERSION 1
+#define TRIANGLE_NET_FILE_ALIGN 64
+#define TRIANGLE_NET_FILE_BYTE_ORDER 0x01020304
+
+enum TriangleNetFileSectionId {
+    SECTION_VERTICES = 0,
+    SECTION_INDICES,
+    SECTION_ADJ_OFFSETS,
+    SECTION_ADJ_NEIGHBORS,
+    SECTION_ADJ_COUNTS,
+    SECTION_LOOP_OFFSETS,
+    SECTION_LOOP_VERTICES,
+    SECTION_COUNT
+};
+
+struct TriangleNetFileSection {
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct alignas(TRIANGLE_NET_FILE_ALIGN) TriangleNetFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    // Components per vertex and bytes per component.
+    uint32_t dimension;
+    uint32_t scalarSize;
+
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t adjacencyCount;
+    uint64_t loopCount;
+    uint64_t loopVertexCount;
+    TriangleNetFileSection sections[SECTION_COUNT];
+};
+
+// Writes the file one section at a time. Sections must be written in order,
+// but each section can be fed in as many chunks as needed, so nets that do
+// not fit in memory can be streamed to disk. The header is filled in on Close.
+class TriangleNetWriter
+{
+private:
+    FILE *file = nullptr;
+    uint64_t position = 0;
+    int section = -1;
+    bool inSection = false;
+    TriangleNetFileHeader header = {};
+
+    bool Pad();
+
+public:
+    TriangleNetWriter() {};
+    ~TriangleNetWriter();
+    TriangleNetWriter(const TriangleNetWriter&) = delete;
+    TriangleNetWriter &operator=(const TriangleNetWriter&) = delete;
+
+    bool Open(const char *path, uint32_t dimension=2, uint32_t scalarSize=sizeof(float));
+    bool BeginSection(int id);
+    bool Write(const void *data, size_t bytes);
+    bool EndSection();
+    bool Close();
+};
+
+// Read-only view of a triangle net file. All arrays point straight into
+// the mapped file, nothing is copied.
+class TriangleNetView
+{
+private:
+    void *data = nullptr;
+    size_t dataSize = 0;
+    bool mapped = false;
+
+    const void *GetSection(int id);
+    // False when the neighbor range of u is out of bounds.
+    bool HasNeighbors(int u);
+
+public:
+    const TriangleNetFileHeader *header = nullptr;
+    // Raw vertex data, use GetVertices for typed access.
+    const void *vertexData = nullptr;
+    const uint32_t *indices = nullptr;
+    const uint32_t *adjOffsets = nullptr;
+    const uint32_t *adjNeighbors = nullptr;
+    const uint32_t *adjCounts = nullptr;
+    const uint32_t *loopOffsets = nullptr;
+    const uint32_t *loopVertices = nullptr;
+
+    TriangleNetView() {};
+    ~TriangleNetView();
+    TriangleNetView(const TriangleNetView&) = delete;
+    TriangleNetView &operator=(const TriangleNetView&) = delete;
+
+    bool Open(const char *path);
+    void Close();
+    int GetVertexCount();
+    int GetLoopCount();
+    int GetEdgeCount(int u, int v);
+    bool IsEdgeInternal(int u, int v);
+    bool IsVertexInternal(int u);
+    // Returns the vertex indices of a boundary loop without copying.
+    const uint32_t *GetLoop(int loop, int *count);
+    // Returns null when the file holds a different vertex type.
+    template<typename V=Vector2>
+    const V *GetVertices();
+    template<typename V=Vector2>
+    vector<V> GetPolygon(int loop=0);
+};
+
+template<typename V>
+const V *TriangleNetView::GetVertices()
+{
+    typedef VertexTraits<V> Traits;
+    if (!header || header->dimension != Traits::dimension || header->scalarSize != sizeof(typename Traits::Scalar))
+        return nullptr;
+    return (const V *)vertexData;
+}
+template<typename V>
+vector<V> TriangleNetView::GetPolygon(int loop)
+{
+    int count = 0;
+    const uint32_t *loopIndices = GetLoop(loop, &count);
+    const V *vertices = GetVertices<V>();
+    vector<V> list;
+    if (!vertices) return list;
+    list.reserve(count);
+    for (int i = 0; i < count; i++) {
+        if (loopIndices[i] >= header->vertexCount) {
+            list.clear();
+            break;
+        }
+        list.push_back(vertices[loopIndices[i]]);
+    }
+    return list;
+}
+
+// Implemented for Vector2, Vector3 and their double variants.
+template<typename V>
+bool SaveTriangleNet(TriangleNetBase<V> &net, const char *path);
+
+#endif
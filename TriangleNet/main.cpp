@@ -26,6 +26,7 @@ int main()
     net.AddTriangles(verts);
 
     vector<Vector2> selectedVerts;
+    vector<vector<Vector2>> addedTriangles;
     vector<Vector2> polygon = net.GetPolygon();
     Vector2 mouseInv = {};
     Vector2 nearestVertex = {};
@@ -60,10 +61,17 @@ int main()
             selectedVerts.push_back(nearestVertex);
             if (selectedVerts.size() == 3) {
                 net.AddTriangles(selectedVerts);
+                addedTriangles.push_back(selectedVerts);
                 polygon = net.GetPolygon();
                 selectedVerts.clear();
             }
         }
+        // Undo the last added triangle.
+        if (IsKeyPressed(KEY_Z) && !addedTriangles.empty()) {
+            net.RemoveTriangles(addedTriangles.back());
+            addedTriangles.pop_back();
+            polygon = net.GetPolygon();
+        }
         if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT)) {
             float minDist = 9999;
             int nearest = 0;
@@ -84,4 +92,7 @@ int main()
         }
         EndDrawing();
     }
+
+    net.UnloadRenderCache();
+    CloseWindow();
 }
\ No newline at end of file